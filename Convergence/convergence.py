@@ -1,7 +1,31 @@
+import argparse
+import re
+import sys
 import numpy as np
 import matplotlib.pyplot as plt
 
-nsteps, y0, y1, y2 = np.loadtxt("tol_1e-12.txt", skiprows=3, unpack=True)
+parser = argparse.ArgumentParser(description="Measure the convergence order of SDC integrations.")
+parser.add_argument("files", nargs="*", default=["tol_1e-12.txt"],
+                    help="convergence data files, one run per row: [# steps] [Y0] [Y1] ...")
+parser.add_argument("--floor", type=float, default=1.0e-11,
+                    help="errors below this are treated as roundoff and not used to measure the order")
+parser.add_argument("--slack", type=float, default=0.3,
+                    help="accept a measured order this far below the expected order")
+parser.add_argument("--plot", default="test_sdc_convergence_c.png",
+                    help="file name for the plot of the order against the timestep")
+args = parser.parse_args()
+
+def read_expected_order(file_name):
+    # files written by Examples/convergence have a header line
+    # "# nodes: <nodes> order: <order> number of nodes: <M>"
+    with open(file_name) as f:
+        for line in f:
+            if not line.startswith("#"):
+                break
+            match = re.search(r"nodes: (\S+) order: (\d+)", line)
+            if match:
+                return match.group(1), int(match.group(2))
+    return None, None
 
 def compute_delta(y):
     dy = []
@@ -10,12 +34,6 @@ def compute_delta(y):
     dy.append(0.0)
     return np.array(dy)
 
-dy0 = compute_delta(y0)
-dy1 = compute_delta(y1)
-dy2 = compute_delta(y2)
-
-dynorm = np.sqrt(dy0**2 + dy1**2 + dy2**2)
-
 def compute_order(dy):
     order = [0.0]
     for i in range(1, dy.size-1):
@@ -23,30 +41,73 @@ def compute_order(dy):
     order.append(0.0)
     return np.array(order)
 
-oy0 = compute_order(dy0)
-oy1 = compute_order(dy1)
-oy2 = compute_order(dy2)
-oynorm = compute_order(dynorm)
+fig = plt.figure()
+ax = fig.add_subplot(111)
+ax.set_xlabel("dt")
+ax.set_ylabel("order")
 
-for n, o0, o1, o2, d0, d1, d2, on, dn in zip(nsteps, oy0, oy1, oy2, dy0, dy1, dy2, oynorm, dynorm):
-    print("{} {} {} {} {} {} {} {} {}".format(n, o0, d0, o1, d1, o2, d2, on, dn))
+failed = False
 
-print("---")
+for file_name in args.files:
+    data = np.loadtxt(file_name, ndmin=2)
+    nsteps = data[:,0]
+    ys = [data[:,i] for i in range(1, data.shape[1])]
 
-p = []
+    # errors are measured against the run with the most steps
+    dys = [compute_delta(y) for y in ys]
+    dynorm = np.sqrt(sum(dy**2 for dy in dys))
+    oys = [compute_order(dy) for dy in dys]
+    oynorm = compute_order(dynorm)
 
-for i in range(1, nsteps.size-1):
-    p.append(np.log10(dynorm[i]/dynorm[i-1])/np.log10(nsteps[i-1]/nsteps[i]))
+    print(file_name)
+    for i in range(nsteps.size):
+        columns = [nsteps[i]]
+        for oy, dy in zip(oys, dys):
+            columns += [oy[i], dy[i]]
+        columns += [oynorm[i], dynorm[i]]
+        print(" ".join("{}".format(c) for c in columns))
 
-print(p)
+    print("---")
 
-fig = plt.figure()
-ax = fig.add_subplot(111)
+    p = []
 
-time_steps = 1.0/nsteps
+    for i in range(1, nsteps.size-1):
+        p.append(np.log10(dynorm[i]/dynorm[i-1])/np.log10(nsteps[i-1]/nsteps[i]))
 
-ax.set_xlabel("dt")
-ax.set_ylabel("order")
-ax.plot(time_steps[:-2], p)
-fig.savefig("test_sdc_convergence_c.png")
+    print(p)
+
+    time_steps = 1.0/nsteps
+
+    nodes, expected_order = read_expected_order(file_name)
+    label = file_name if nodes is None else "{} order {}".format(nodes, expected_order)
+    ax.plot(time_steps[1:-1], p, label=label)
+
+    if expected_order is None:
+        print()
+        continue
+
+    # The measured order is taken from the finest pair of runs that are
+    # both above roundoff, skipping the run next to the reference run,
+    # where the error of the reference itself is still significant.
+    measured_order = None
+    for i in range(1, nsteps.size-2):
+        if dynorm[i] > args.floor and dynorm[i-1] > args.floor:
+            measured_order = p[i-1]
+
+    if measured_order is None:
+        print("{}: no runs above the roundoff floor {}".format(label, args.floor))
+        failed = True
+    elif measured_order < expected_order - args.slack:
+        print("{}: measured order {:.2f} FAILED, expected {}".format(label, measured_order, expected_order))
+        failed = True
+    else:
+        print("{}: measured order {:.2f} passed, expected {}".format(label, measured_order, expected_order))
+
+    print()
+
+if len(args.files) > 1:
+    ax.legend(fontsize="small")
+fig.savefig(args.plot)
 
+if failed:
+    sys.exit(1)
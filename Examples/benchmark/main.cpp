@@ -0,0 +1,537 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <limits>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <map>
+#include <cstdlib>
+
+#include "SdcIntegrator.H"
+#include "SdcHostDriver.H"
+#include "SdcCounters.H"
+#include "BatchScheduler.H"
+#include "WallTimer.H"
+#include "RealVector.H"
+#include "benchmark_problems.H"
+
+// Stiff ODE benchmark suite.
+//
+// Every combination of the comma separated values given on the command
+// line is run, and each run writes one line of JSON with its throughput
+// and the distribution of the integration counters over the systems.
+// See README.md for the arguments.
+
+class BenchmarkOptions {
+public:
+  std::vector<std::string> problems;
+  std::vector<size_t> batch_sizes;
+  std::vector<size_t> orders;
+  std::vector<std::string> nodes;
+  std::vector<Real> tolerances;
+  std::vector<bool> adaptive;
+  std::vector<std::string> controls;
+  std::vector<std::string> solvers;
+  std::vector<bool> reuse;
+  std::vector<bool> mixed;
+  std::vector<bool> simd;
+  std::vector<size_t> calls;
+  std::vector<bool> warm;
+  std::vector<size_t> threads;
+  size_t chunk_size;
+  size_t maximum_newton_iters;
+  Real variation;
+  size_t reference_systems;
+  std::string output;
+
+  BenchmarkOptions() {
+    problems = {"robertson", "hires", "pollution", "oregonator", "synthetic"};
+    batch_sizes = {1024};
+    orders = {4};
+    nodes = {"uniform"};
+    tolerances = {1.0e-8};
+    adaptive = {false, true};
+    controls = {"sweep"};
+    solvers = {"default"};
+    reuse = {false};
+    mixed = {false};
+    simd = {false};
+    calls = {1};
+    warm = {false};
+    threads = {0};
+    chunk_size = 4;
+    maximum_newton_iters = 100;
+    variation = 0.1;
+    reference_systems = 8;
+  }
+};
+
+// One point of the sweep
+class BenchmarkRun {
+public:
+  std::string problem;
+  size_t batch_size;
+  size_t order;
+  std::string nodes;
+  Real tolerance;
+  bool adaptive;
+  std::string control;
+  std::string solver;
+  bool reuse;
+  bool mixed;
+  bool simd;
+  size_t calls;
+  bool warm;
+  size_t threads;
+  size_t chunk_size;
+  size_t maximum_newton_iters;
+  Real variation;
+  size_t reference_systems;
+};
+
+std::vector<std::string> split_list(const std::string& list) {
+  std::vector<std::string> items;
+  std::stringstream stream(list);
+  std::string item;
+  while (std::getline(stream, item, ',')) {
+    if (!item.empty()) items.push_back(item);
+  }
+  return items;
+}
+
+bool parse_bool(const std::string& value) {
+  return value == "1" || value == "true" || value == "yes";
+}
+
+bool parse_options(int argc, char* argv[], BenchmarkOptions& options) {
+  for (int iarg = 1; iarg < argc; iarg++) {
+    std::string arg(argv[iarg]);
+    size_t equals = arg.find('=');
+    if (equals == std::string::npos) {
+      std::cerr << "expected key=value, got " << arg << std::endl;
+      return false;
+    }
+    std::string key = arg.substr(0, equals);
+    std::vector<std::string> values = split_list(arg.substr(equals + 1));
+    if (values.empty()) {
+      std::cerr << "no value given for " << key << std::endl;
+      return false;
+    }
+
+    if (key == "problems") {
+      options.problems = values;
+    } else if (key == "batch") {
+      options.batch_sizes.clear();
+      for (auto& v : values) {
+        size_t batch = std::stoul(v);
+        if (batch == 0) {
+          std::cerr << "batch must be at least 1" << std::endl;
+          return false;
+        }
+        options.batch_sizes.push_back(batch);
+      }
+    } else if (key == "order") {
+      options.orders.clear();
+      for (auto& v : values) options.orders.push_back(std::stoul(v));
+    } else if (key == "nodes") {
+      options.nodes = values;
+    } else if (key == "tol") {
+      options.tolerances.clear();
+      for (auto& v : values) options.tolerances.push_back(std::stod(v));
+    } else if (key == "adaptive") {
+      options.adaptive.clear();
+      for (auto& v : values) options.adaptive.push_back(parse_bool(v));
+    } else if (key == "control") {
+      options.controls = values;
+      for (auto& v : values) {
+        if (v != "sweep" && v != "newton") {
+          std::cerr << "unknown control " << v << " (sweep, newton)" << std::endl;
+          return false;
+        }
+      }
+    } else if (key == "solver") {
+      options.solvers = values;
+      for (auto& v : values) {
+        if (v != "default" && v != "sparse_lu") {
+          std::cerr << "unknown solver " << v << " (default, sparse_lu)" << std::endl;
+          return false;
+        }
+      }
+    } else if (key == "reuse") {
+      options.reuse.clear();
+      for (auto& v : values) options.reuse.push_back(parse_bool(v));
+    } else if (key == "mixed") {
+      options.mixed.clear();
+      for (auto& v : values) {
+        options.mixed.push_back(parse_bool(v));
+        if (options.mixed.back() && !sdc_mixed_precision_enabled()) {
+          std::cerr << "mixed precision is compiled out, compile with USE_SDC_MIXED_PRECISION=TRUE" << std::endl;
+          return false;
+        }
+      }
+    } else if (key == "simd") {
+      options.simd.clear();
+      for (auto& v : values) options.simd.push_back(parse_bool(v));
+    } else if (key == "calls") {
+      options.calls.clear();
+      for (auto& v : values) {
+        options.calls.push_back(std::stoul(v));
+        if (options.calls.back() == 0) {
+          std::cerr << "calls must be at least 1" << std::endl;
+          return false;
+        }
+      }
+    } else if (key == "warm") {
+      options.warm.clear();
+      for (auto& v : values) options.warm.push_back(parse_bool(v));
+    } else if (key == "threads") {
+      options.threads.clear();
+      for (auto& v : values) options.threads.push_back(std::stoul(v));
+    } else if (key == "chunk") {
+      options.chunk_size = std::stoul(values[0]);
+    } else if (key == "newton") {
+      options.maximum_newton_iters = std::stoul(values[0]);
+    } else if (key == "variation") {
+      options.variation = std::stod(values[0]);
+    } else if (key == "reference") {
+      options.reference_systems = std::stoul(values[0]);
+    } else if (key == "output") {
+      options.output = values[0];
+    } else {
+      std::cerr << "unknown option " << key << std::endl;
+      return false;
+    }
+  }
+  return true;
+}
+
+// Distribution of one counter over the systems of a batch
+void write_distribution(std::ostream& out, std::vector<size_t>& values) {
+  std::sort(values.begin(), values.end());
+  size_t total = 0;
+  for (size_t v : values) total += v;
+  size_t n = values.size();
+  auto percentile = [&](double p) { return values[std::min(n - 1, static_cast<size_t>(p * n))]; };
+
+  out << "{\"total\": " << total
+      << ", \"mean\": " << static_cast<double>(total) / n
+      << ", \"min\": " << values[0]
+      << ", \"p50\": " << percentile(0.5)
+      << ", \"p90\": " << percentile(0.9)
+      << ", \"p99\": " << percentile(0.99)
+      << ", \"max\": " << values[n - 1] << "}";
+}
+
+// Vary the initial state from system to system so the counters
+// have a distribution across the batch
+template<class Problem>
+void initial_states(Real* y_initial, size_t size, Real variation) {
+  const size_t neqs = Problem::System::neqs;
+  for (size_t cell = 0; cell < size; cell++) {
+    Real* y = &y_initial[cell * neqs];
+    Problem::initial_state(y);
+    Real fraction = std::fmod(0.6180339887498949 * cell, 1.0);
+    for (size_t i = 0; i < neqs; i++) {
+      y[i] *= 1.0 + variation * fraction;
+    }
+  }
+}
+
+// Final states of the first count systems of every batch, integrated once
+// per problem with order 5 Radau IIA SDC, all sweeps and fixed steps ten
+// times smaller than the problem timestep, as the reference for the
+// solution error of each run.
+template<class Problem>
+const std::vector<Real>& reference_states(size_t count, Real variation) {
+  typedef typename Problem::System System;
+  typedef SdcHostDriver<typename Problem::Solver, System, 5, SdcNodesRadauIIA> ReferenceDriver;
+
+  static std::vector<Real> y_reference;
+  if (y_reference.size() == count * System::neqs) return y_reference;
+
+  std::vector<Real> y_initial(count * System::neqs);
+  initial_states<Problem>(y_initial.data(), count, variation);
+  y_reference.resize(count * System::neqs);
+
+  SdcCounters totals;
+  ReferenceDriver::integrate_range(y_initial.data(), y_reference.data(),
+                                   Problem::start_time(), Problem::end_time(),
+                                   Problem::timestep() / 10.0,
+                                   1.0e-12, 100, true, 1000000,
+                                   std::numeric_limits<Real>::epsilon(),
+                                   false, false, false, false,
+                                   0, count, totals);
+  if (totals.failures > 0) {
+    std::cerr << "warning: reference integration of " << Problem::name() << " failed" << std::endl;
+  }
+  return y_reference;
+}
+
+template<class Problem, size_t order, class NodeFamily>
+void run_benchmark(const BenchmarkRun& run, std::ostream& out) {
+  typedef typename Problem::System System;
+  typedef typename Problem::Solver Solver;
+  typedef SdcHostDriver<Solver, System, order, NodeFamily> SdcDriver;
+
+  const size_t neqs = System::neqs;
+  const size_t size = run.batch_size;
+
+  // The systems are integrated in place, in run.calls consecutive calls
+  // over equal parts of the interval as an operator split code would.
+  // With run.warm every call starts from the timesteps the previous
+  // call ended with, otherwise from the problem timestep.
+  std::vector<Real> y_final(neqs * size);
+  std::vector<Real> timestep_hints(size, 0.0);
+  std::vector<SdcCounters> cell_counters(size);
+  std::vector<SdcCounters> call_counters(size);
+
+  initial_states<Problem>(y_final.data(), size, run.variation);
+
+  SdcStateLayout layout = SdcStateLayout::cells_contiguous(size, neqs);
+  SdcStateLayout hint_layout = SdcStateLayout::cells_contiguous(size, 1);
+
+  std::vector<BatchThreadStats> thread_stats;
+  SdcCounters totals;
+  WallTimer timer;
+  double busy_time = 0.0;
+
+  timer.start_wallclock();
+  Real call_interval = (Problem::end_time() - Problem::start_time()) / run.calls;
+  for (size_t call = 0; call < run.calls; call++) {
+    Real call_start = Problem::start_time() + call * call_interval;
+    Real call_end = (call + 1 == run.calls) ? Problem::end_time() : call_start + call_interval;
+    SdcDriver::integrate_in_place(y_final.data(), layout,
+                                  run.warm ? timestep_hints.data() : nullptr, hint_layout,
+                                  nullptr,
+                                  call_start, call_end, Problem::timestep(),
+                                  run.tolerance, run.maximum_newton_iters,
+                                  true, 1000000,
+                                  std::numeric_limits<Real>::epsilon(), run.adaptive,
+                                  run.reuse, run.control == "sweep", run.mixed,
+                                  run.threads, run.chunk_size,
+                                  thread_stats, totals,
+                                  run.simd, call_counters.data());
+    for (auto& tstats : thread_stats) busy_time += tstats.busy_time;
+    for (size_t cell = 0; cell < size; cell++) cell_counters[cell].add(call_counters[cell]);
+  }
+  timer.stop_wallclock();
+  double walltime = timer.get_walltime();
+
+  // Time the right hand side alone at the final states, on one thread
+  const size_t rhs_repeats = std::max(static_cast<size_t>(1), static_cast<size_t>(200000) / size);
+  RealVector<neqs> y_rhs, f_rhs;
+  Real rhs_checksum = 0.0;
+  WallTimer rhs_timer;
+  rhs_timer.start_wallclock();
+  for (size_t repeat = 0; repeat < rhs_repeats; repeat++) {
+    for (size_t cell = 0; cell < size; cell++) {
+      for (size_t i = 0; i < neqs; i++) y_rhs.data[i] = y_final[cell * neqs + i];
+      System::evaluate(Problem::end_time(), y_rhs, f_rhs);
+      // Use every component, so no part of the evaluation can be dropped,
+      // weighted so that conserved sums do not cancel
+      for (size_t i = 0; i < neqs; i++) rhs_checksum += (i + 1) * f_rhs.data[i];
+    }
+  }
+  rhs_timer.stop_wallclock();
+  double rhs_time = rhs_timer.get_walltime() / (rhs_repeats * size);
+
+  Real solution_checksum = 0.0;
+  for (Real y : y_final) solution_checksum += y;
+
+  // Largest error of the first systems relative to the reference states,
+  // in the max norm scaled by the largest reference component
+  size_t reference_count = std::min(run.reference_systems, size);
+  Real solution_error = 0.0;
+  if (reference_count > 0) {
+    const std::vector<Real>& y_reference = reference_states<Problem>(run.reference_systems, run.variation);
+    for (size_t cell = 0; cell < reference_count; cell++) {
+      Real error = 0.0;
+      Real scale = 0.0;
+      for (size_t i = 0; i < neqs; i++) {
+        error = std::max(error, std::fabs(y_final[cell * neqs + i] - y_reference[cell * neqs + i]));
+        scale = std::max(scale, std::fabs(y_reference[cell * neqs + i]));
+      }
+      solution_error = std::max(solution_error, error / scale);
+    }
+  }
+
+  out << std::setprecision(std::numeric_limits<Real>::digits10 + 1);
+  out << "{\"problem\": \"" << Problem::name() << "\""
+      << ", \"neqs\": " << neqs
+      << ", \"nnz\": " << System::nnz
+      << ", \"batch\": " << size
+      << ", \"order\": " << order
+      << ", \"nodes\": \"" << run.nodes << "\""
+      << ", \"number_nodes\": " << NodeFamily::number_nodes(order)
+      << ", \"tolerance\": " << run.tolerance
+      << ", \"adaptive\": " << (run.adaptive ? "true" : "false")
+      << ", \"error_control\": \"" << run.control << "\""
+      << ", \"solver\": \"" << Problem::solver_name() << "\""
+      << ", \"jacobian_reuse\": " << (run.reuse ? "true" : "false")
+      << ", \"mixed_precision\": " << (run.mixed ? "true" : "false")
+      << ", \"simd\": " << (run.simd ? "true" : "false")
+      << ", \"simd_width\": " << SDC_SIMD_WIDTH
+      << ", \"calls\": " << run.calls
+      << ", \"warm_start\": " << (run.warm ? "true" : "false")
+      << ", \"threads\": " << thread_stats.size()
+      << ", \"walltime\": " << walltime
+      << ", \"busy_time\": " << busy_time
+      << ", \"systems_per_second\": " << size / walltime
+      << ", \"rhs_seconds\": " << rhs_time
+      << ", \"solution_checksum\": " << solution_checksum;
+  if (reference_count > 0)
+    out << ", \"solution_error\": " << solution_error;
+  else
+    out << ", \"solution_error\": null";
+
+  if (SdcCounters::enabled()) {
+    size_t failed_systems = 0;
+    for (auto& c : cell_counters) failed_systems += (c.failures > 0);
+
+    out << ", \"failed_systems\": " << failed_systems;
+    if (totals.rhs_evaluations > 0)
+      out << ", \"busy_seconds_per_rhs\": " << busy_time / totals.rhs_evaluations;
+    else
+      out << ", \"busy_seconds_per_rhs\": null";
+    out << ", \"counters\": {";
+    for (size_t k = 0; k < SdcCounters::number_counters; k++) {
+      std::vector<size_t> values(size);
+      for (size_t cell = 0; cell < size; cell++) values[cell] = cell_counters[cell].value(k);
+      out << (k > 0 ? ", " : "") << "\"" << SdcCounters::name(k) << "\": ";
+      write_distribution(out, values);
+    }
+    out << "}";
+  } else {
+    out << ", \"failed_systems\": null, \"busy_seconds_per_rhs\": null, \"counters\": null";
+  }
+  out << "}" << std::endl;
+
+  std::cerr << std::setw(10) << Problem::name()
+            << " batch " << size << " order " << order << " " << run.nodes
+            << " tol " << run.tolerance
+            << (run.adaptive ? " adaptive" : " fixed") << " " << run.control
+            << " " << Problem::solver_name() << (run.reuse ? " reuse" : "")
+            << (run.mixed ? " mixed" : "")
+            << (run.simd ? " simd" : "")
+            << (run.calls > 1 ? " calls " + std::to_string(run.calls) : "")
+            << (run.warm ? " warm" : "")
+            << " threads " << thread_stats.size()
+            << ": " << size / walltime << " systems/s"
+            << ", error " << solution_error
+            << " (rhs checksum " << rhs_checksum << ")" << std::endl;
+}
+
+template<class Problem, class NodeFamily>
+bool dispatch_order(const BenchmarkRun& run, std::ostream& out) {
+  switch (run.order) {
+  case 2: run_benchmark<Problem, 2, NodeFamily>(run, out); return true;
+  case 3: run_benchmark<Problem, 3, NodeFamily>(run, out); return true;
+  case 4: run_benchmark<Problem, 4, NodeFamily>(run, out); return true;
+  case 5: run_benchmark<Problem, 5, NodeFamily>(run, out); return true;
+  case 6: run_benchmark<Problem, 6, NodeFamily>(run, out); return true;
+  case 8: run_benchmark<Problem, 8, NodeFamily>(run, out); return true;
+  default:
+    std::cerr << "order " << run.order << " is not compiled in (2, 3, 4, 5, 6, 8)" << std::endl;
+    return false;
+  }
+}
+
+template<class Problem>
+bool dispatch_nodes(const BenchmarkRun& run, std::ostream& out) {
+  // SdcIntegrator ignores Jacobian reuse for solvers that do not keep their
+  // factors, so such runs would only repeat the runs without it
+  if (run.reuse && !SdcKeepsFactors<typename Problem::Solver>::value) {
+    std::cerr << "skipping reuse for " << Problem::name() << ": the "
+              << Problem::solver_name() << " solver does not keep its factors" << std::endl;
+    return true;
+  }
+  if (run.nodes == "uniform") return dispatch_order<Problem, SdcNodesUniform>(run, out);
+  if (run.nodes == "lobatto") return dispatch_order<Problem, SdcNodesGaussLobatto>(run, out);
+  if (run.nodes == "radau") return dispatch_order<Problem, SdcNodesRadauIIA>(run, out);
+  std::cerr << "unknown nodes " << run.nodes << " (uniform, lobatto, radau)" << std::endl;
+  return false;
+}
+
+template<class Problem>
+bool dispatch_solver(const BenchmarkRun& run, std::ostream& out) {
+  if (run.solver == "sparse_lu") return dispatch_nodes<SparseLUProblem<Problem>>(run, out);
+  return dispatch_nodes<Problem>(run, out);
+}
+
+bool dispatch_problem(const BenchmarkRun& run, std::ostream& out) {
+  if (run.problem == "robertson") return dispatch_solver<RobertsonProblem>(run, out);
+  if (run.problem == "hires") return dispatch_solver<HiresProblem>(run, out);
+  if (run.problem == "pollution") return dispatch_solver<PollutionProblem>(run, out);
+  if (run.problem == "oregonator") return dispatch_solver<OregonatorProblem>(run, out);
+  if (run.problem == "synthetic") return dispatch_solver<SyntheticProblem>(run, out);
+  std::cerr << "unknown problem " << run.problem
+            << " (robertson, hires, pollution, oregonator, synthetic)" << std::endl;
+  return false;
+}
+
+int main(int argc, char* argv[]) {
+  BenchmarkOptions options;
+  if (!parse_options(argc, argv, options)) return 1;
+
+  std::ofstream output_file;
+  if (!options.output.empty()) output_file.open(options.output);
+  std::ostream& out = options.output.empty() ? std::cout : output_file;
+
+  if (!SdcCounters::enabled()) {
+    std::cerr << "counters are compiled out, only timings are reported" << std::endl;
+  }
+
+  BenchmarkRun run;
+  run.chunk_size = options.chunk_size;
+  run.maximum_newton_iters = options.maximum_newton_iters;
+  run.variation = options.variation;
+  run.reference_systems = options.reference_systems;
+
+  for (auto& problem : options.problems) {
+    for (size_t batch_size : options.batch_sizes) {
+      for (size_t order : options.orders) {
+        for (auto& nodes : options.nodes) {
+          for (Real tolerance : options.tolerances) {
+            for (bool adaptive : options.adaptive) {
+              for (auto& control : options.controls) {
+                for (auto& solver : options.solvers) {
+                  for (bool reuse : options.reuse) {
+                    for (bool mixed : options.mixed) {
+                      for (bool simd : options.simd) {
+                        for (size_t calls : options.calls) {
+                          for (bool warm : options.warm) {
+                            for (size_t threads : options.threads) {
+                              run.problem = problem;
+                              run.batch_size = batch_size;
+                              run.order = order;
+                              run.nodes = nodes;
+                              run.tolerance = tolerance;
+                              run.adaptive = adaptive;
+                              run.control = control;
+                              run.solver = solver;
+                              run.reuse = reuse;
+                              run.mixed = mixed;
+                              run.simd = simd;
+                              run.calls = calls;
+                              run.warm = warm;
+                              run.threads = threads;
+                              if (!dispatch_problem(run, out)) return 1;
+                            }
+                          }
+                        }
+                      }
+                    }
+                  }
+                }
+              }
+            }
+          }
+        }
+      }
+    }
+  }
+
+  return 0;
+}
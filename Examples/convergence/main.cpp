@@ -0,0 +1,86 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <limits>
+#include <string>
+
+#include "SdcIntegrator.H"
+#include "SdcHostDriver.H"
+#include "PendulumGaussJordan.H"
+#include "pendulum_system.H"
+#include "RealVector.H"
+
+// Integrate the pendulum system from t=0 to t=1 with fixed timesteps,
+// halving the timestep each run, and write the final states to
+// <nodes>_order<order>.txt in the format read by Convergence/convergence.py.
+// Error control is off so every step takes all order sweeps.
+
+const size_t number_runs = 10;
+const size_t first_number_steps = 1;
+
+template<class NodeFamily, size_t order>
+void write_convergence(const std::string& node_name) {
+  typedef SdcHostDriver<PendulumGaussJordan, PendulumSystem, order, NodeFamily> SdcDriver;
+
+  Real start_time = 0.0;
+  Real end_time = 1.0;
+  Real tolerance = 1.0e-12;
+  size_t maximum_newton_iters = 1000;
+  size_t maximum_steps = 1000000;
+  bool fail_if_maximum_newton = true;
+  Real epsilon = std::numeric_limits<Real>::epsilon();
+
+  std::ostringstream file_name;
+  file_name << node_name << "_order" << order << ".txt";
+
+  std::ofstream output(file_name.str());
+  output << std::setprecision(std::numeric_limits<Real>::digits10 + 1);
+  output << "# Integration of the pendulum system from t=0 to t=1" << std::endl;
+  output << "# Newton solver tolerance is " << tolerance << "." << std::endl;
+  output << "# nodes: " << node_name << " order: " << order
+         << " number of nodes: " << NodeFamily::number_nodes(order) << std::endl;
+  output << "# [# steps] [Y0] [Y1]" << std::endl;
+
+  size_t number_steps = first_number_steps;
+  for (size_t irun = 0; irun < number_runs; irun++) {
+    Real y_initial[PendulumSystem::neqs] = {1.0, 0.0};
+    Real y_final[PendulumSystem::neqs];
+    Real timestep = (end_time - start_time)/number_steps;
+    SdcCounters counter_totals;
+
+    SdcDriver::integrate_range(y_initial, y_final,
+                               start_time, end_time, timestep,
+                               tolerance, maximum_newton_iters,
+                               fail_if_maximum_newton, maximum_steps,
+                               epsilon, false, false, false, false,
+                               0, 1, counter_totals);
+
+    output << static_cast<Real>(number_steps) << " ";
+    for (size_t i = 0; i < PendulumSystem::neqs; i++) {
+      output << y_final[i] << " ";
+    }
+    output << std::endl;
+
+    number_steps *= 2;
+  }
+
+  std::cout << "wrote " << file_name.str() << std::endl;
+}
+
+int main() {
+  write_convergence<SdcNodesUniform, 2>("uniform");
+  write_convergence<SdcNodesUniform, 3>("uniform");
+  write_convergence<SdcNodesUniform, 4>("uniform");
+  write_convergence<SdcNodesUniform, 6>("uniform");
+
+  write_convergence<SdcNodesGaussLobatto, 4>("lobatto");
+  write_convergence<SdcNodesGaussLobatto, 6>("lobatto");
+  write_convergence<SdcNodesGaussLobatto, 8>("lobatto");
+
+  write_convergence<SdcNodesRadauIIA, 3>("radau");
+  write_convergence<SdcNodesRadauIIA, 5>("radau");
+  write_convergence<SdcNodesRadauIIA, 7>("radau");
+
+  return 0;
+}
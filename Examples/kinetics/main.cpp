@@ -1,32 +1,39 @@
 #include <iostream>
+#include <vector>
+#include <cstdlib>
+#include <string>
 
 #ifdef AMREX_USE_CUDA
 #include <cuda_profiler_api.h>
 #endif
 
 #include "SdcIntegrator.H"
+#include "SdcInPlace.H"
 #include "SparseGaussJordan.H"
 #include "vode_system.H"
 #include "RealVector.H"
 #include "WallTimer.H"
+#ifndef AMREX_USE_CUDA
+#include "SdcHostDriver.H"
+#endif
 
 #ifdef AMREX_USE_CUDA
 template<class SparseLinearSolver, class SystemClass, size_t order>
 __global__
-void do_sdc_kernel(Real* y_initial, Real* y_final, 
+void do_sdc_kernel(Real* state, SdcStateLayout layout,
+		   Real* timestep_hints, SdcStateLayout hint_layout,
 		   Real start_time, Real end_time, Real start_timestep,
                    Real tolerance, size_t maximum_newton_iters, 
 		   bool fail_if_maximum_newton, Real maximum_steps,
 		   Real epsilon, size_t size, bool use_adaptive_timestep) {
 
-  typedef SdcIntegrator<SparseLinearSolver,SystemClass,order> SdcIntClass;
+  typedef SdcInPlace<SparseLinearSolver,SystemClass,order> SdcInPlaceClass;
 
   const size_t WarpBatchSize = 128;
   const size_t WarpSize = 32;
   size_t warp_batch_id = blockIdx.x * WarpBatchSize;
   size_t global_index, local_index;
 
-  SystemClass ode_system;
   global_index = threadIdx.x + warp_batch_id;
 
   if (global_index >= size) return;
@@ -34,76 +41,18 @@ void do_sdc_kernel(Real* y_initial, Real* y_final,
   for (local_index = threadIdx.x; local_index < WarpBatchSize && global_index < size; local_index += WarpSize) {
     global_index = local_index + warp_batch_id;
 
-    SdcIntClass sdc;
-    RealVector<SystemClass::neqs> y_ini;
-
-    for (size_t i = 0; i < SystemClass::neqs; i++) {
-      y_ini.data[i] = y_initial[global_index * SystemClass::neqs + i];
-    }
-
-    SdcIntClass::set_jacobian_layout(sdc, ode_system);
-    SdcIntClass::initialize(sdc, y_ini, 
-			    start_time, end_time, start_timestep,
-			    tolerance, maximum_newton_iters, 
-			    fail_if_maximum_newton, maximum_steps,
-			    epsilon, use_adaptive_timestep);
-
-    for (size_t i = 0; i < maximum_steps; i++) {
-      SdcIntClass::prepare(sdc);
-      SdcIntClass::solve(sdc);
-      SdcIntClass::update(sdc);
-      if (SdcIntClass::is_finished(sdc)) break;
-    }
-
-    RealVector<SystemClass::neqs>& y_fin = SdcIntClass::get_current_solution(sdc);
-    for (size_t i = 0; i < SystemClass::neqs; i++) {
-      y_final[global_index * SystemClass::neqs + i] = y_fin.data[i];
-    }
+    SdcCounters counters;
+    SdcInPlaceClass::integrate_cell(state, layout, global_index,
+				    timestep_hints, hint_layout,
+				    start_time, end_time, start_timestep,
+				    tolerance, maximum_newton_iters,
+				    fail_if_maximum_newton, maximum_steps,
+				    epsilon, use_adaptive_timestep,
+				    false, true, false, counters);
   }
 }
 #endif
 
-template<class SparseLinearSolver, class SystemClass, size_t order>
-void do_sdc_host(Real* y_initial, Real* y_final, 
-		 Real start_time, Real end_time, Real start_timestep,
-		 Real tolerance, size_t maximum_newton_iters, 
-		 bool fail_if_maximum_newton, Real maximum_steps,
-		 Real epsilon, size_t size, bool use_adaptive_timestep) {
-
-  typedef SdcIntegrator<SparseLinearSolver,SystemClass,order> SdcIntClass;
-
-  SystemClass ode_system;
-
-  for (size_t global_index = 0; global_index < size; global_index++) {
-    SdcIntClass sdc;
-    RealVector<SystemClass::neqs> y_ini;
-
-    for (size_t i = 0; i < SystemClass::neqs; i++) {
-      y_ini.data[i] = y_initial[global_index * SystemClass::neqs + i];
-    }
-
-    SdcIntClass::set_jacobian_layout(sdc, ode_system);
-    SdcIntClass::initialize(sdc, y_ini, 
-			    start_time, end_time, start_timestep,
-			    tolerance, maximum_newton_iters, 
-			    fail_if_maximum_newton, maximum_steps,
-			    epsilon, use_adaptive_timestep);
-
-    for (size_t i = 0; i < maximum_steps; i++) {
-      SdcIntClass::prepare(sdc);
-      SdcIntClass::solve(sdc);
-      SdcIntClass::update(sdc);
-      if (SdcIntClass::is_finished(sdc)) break;
-    }
-
-    RealVector<SystemClass::neqs>& y_fin = SdcIntClass::get_current_solution(sdc);
-    for (size_t i = 0; i < SystemClass::neqs; i++) {
-      y_final[global_index * SystemClass::neqs + i] = y_fin.data[i];
-    }
-  }
-}
-
-
 int main(int argc, char* argv[]) {
 
 #ifdef AMREX_USE_CUDA
@@ -118,31 +67,40 @@ int main(int argc, char* argv[]) {
 
   WallTimer timer;
 
-  Real* y_initial;
-  Real* y_final;
+  // The systems are integrated in place in state. timestep_hints holds
+  // the timestep each system ends with, which a following integration
+  // of the same systems would start from.
+  Real* state;
+  Real* timestep_hints;
+
+  SdcStateLayout layout = SdcStateLayout::cells_contiguous(num_systems, VodeSystem::neqs);
+  SdcStateLayout hint_layout = SdcStateLayout::cells_contiguous(num_systems, 1);
 
 #ifndef AMREX_USE_CUDA
-  y_initial = new Real[VodeSystem::neqs * num_systems];
-  y_final = new Real[VodeSystem::neqs * num_systems];
+  state = new Real[VodeSystem::neqs * num_systems];
+  timestep_hints = new Real[num_systems];
 #else
   cudaError_t cuda_status = cudaSuccess;
   void* vp;
   cuda_status = cudaMallocManaged(&vp, sizeof(Real) * VodeSystem::neqs * num_systems);
   assert(cuda_status == cudaSuccess);
 
-  y_initial = static_cast<Real*>(vp);
+  state = static_cast<Real*>(vp);
 
-  cuda_status = cudaMallocManaged(&vp, sizeof(Real) * VodeSystem::neqs * num_systems);
+  cuda_status = cudaMallocManaged(&vp, sizeof(Real) * num_systems);
   assert(cuda_status == cudaSuccess);
 
-  y_final = static_cast<Real*>(vp);
+  timestep_hints = static_cast<Real*>(vp);
 #endif
 
   // initialize systems
-  for (size_t i = 0; i < num_systems; i += VodeSystem::neqs) {
-    y_initial[i] = 1.0;
-    y_initial[i+1] = 0.0;
-    y_initial[i+2] = 0.0;
+  for (size_t i = 0; i < VodeSystem::neqs * num_systems; i += VodeSystem::neqs) {
+    state[i] = 1.0;
+    state[i+1] = 0.0;
+    state[i+2] = 0.0;
+  }
+  for (size_t i = 0; i < num_systems; i++) {
+    timestep_hints[i] = 0.0;
   }
 
   Real start_time = 0.0;
@@ -154,6 +112,31 @@ int main(int argc, char* argv[]) {
   bool fail_if_maximum_newton = true;
   Real epsilon = std::numeric_limits<Real>::epsilon();
   bool use_adaptive_timestep = false;
+  bool use_error_control = true;
+
+#ifndef AMREX_USE_CUDA
+  // host threads for the CPU batch driver, 0 uses all hardware threads
+  size_t num_host_threads = (argc > 1) ? static_cast<size_t>(atoi(argv[1])) : 0;
+  size_t host_chunk_size = 4;
+  // further arguments select optional integration modes:
+  //   simd  - integrate SDC_SIMD_WIDTH systems in lockstep per thread
+  //   reuse - reuse the factored Newton matrix across iterations (scalar path)
+  //   mixed - form and solve the Newton matrix in single precision (scalar path)
+  bool use_simd_batch = false;
+  bool use_jacobian_reuse = false;
+  bool use_mixed_precision = false;
+  for (int iarg = 2; iarg < argc; iarg++) {
+    if (std::string(argv[iarg]) == "simd") use_simd_batch = true;
+    if (std::string(argv[iarg]) == "reuse") use_jacobian_reuse = true;
+    if (std::string(argv[iarg]) == "mixed") use_mixed_precision = true;
+  }
+  if (use_mixed_precision && !sdc_mixed_precision_enabled()) {
+    std::cout << "mixed precision is compiled out, compile with USE_SDC_MIXED_PRECISION=TRUE" << std::endl;
+    return 1;
+  }
+  std::vector<BatchThreadStats> thread_stats;
+  SdcCounters counter_totals;
+#endif
 
   const int nThreads = 32;
   const size_t WarpBatchSize = 128;
@@ -164,15 +147,23 @@ int main(int argc, char* argv[]) {
   timer.start_wallclock();
 
 #ifndef AMREX_USE_CUDA
-  do_sdc_host<SparseGaussJordan, VodeSystem, order>(y_initial, y_final,
-						    start_time, end_time, start_timestep,
-						    tolerance, maximum_newton_iters,
-						    fail_if_maximum_newton, maximum_steps,
-						    epsilon, num_systems, use_adaptive_timestep);
+  SdcHostDriver<SparseGaussJordan, VodeSystem, order>::integrate_in_place(state, layout,
+									  timestep_hints, hint_layout,
+									  nullptr,
+									  start_time, end_time, start_timestep,
+									  tolerance, maximum_newton_iters,
+									  fail_if_maximum_newton, maximum_steps,
+									  epsilon, use_adaptive_timestep,
+									  use_jacobian_reuse, use_error_control,
+									  use_mixed_precision,
+									  num_host_threads, host_chunk_size,
+									  thread_stats, counter_totals,
+									  use_simd_batch);
 #else
   do_sdc_kernel<SparseGaussJordan, 
 		VodeSystem, 
-		order><<<nBlocks, nThreads>>>(y_initial, y_final,
+		order><<<nBlocks, nThreads>>>(state, layout,
+					      timestep_hints, hint_layout,
 					      start_time, end_time, start_timestep,
 					      tolerance, maximum_newton_iters,
 					      fail_if_maximum_newton, maximum_steps,
@@ -187,29 +178,37 @@ int main(int argc, char* argv[]) {
   std::cout << std::endl << "Final Integration States -------------------" << std::endl;
   for (size_t i = 0; i < num_systems; i += VodeSystem::neqs) {
     std::cout << std::setprecision(std::numeric_limits<Real>::digits10 + 1);
-    std::cout << "y_final[" << i << "]: " << std::endl;
+    std::cout << "state[" << i << "]: " << std::endl;
     std::cout << " ";
     for (size_t j = 0; j < VodeSystem::neqs; j++) {
-      std::cout << y_final[i + j] << " ";
+      std::cout << state[i + j] << " ";
     }
     std::cout << std::endl;
   }
 
 #ifndef AMREX_USE_CUDA
-  std::cout << "Finished execution on host CPU" << std::endl;
+  std::cout << "Finished execution on host CPU with " << thread_stats.size() << " threads";
+  if (use_simd_batch) std::cout << " and SIMD width " << SDC_SIMD_WIDTH;
+  std::cout << std::endl;
+  std::cout << std::endl << "Host thread load balance -------------------" << std::endl;
+  BatchScheduler::print_stats(thread_stats);
+  std::cout << std::endl << "Integration counter totals -------------------" << std::endl;
+  counter_totals.print();
 #else
   std::cout << "Finished execution on device" << std::endl;
 #endif
   
   std::cout << std::endl << "Integration walltime (s): " << timer.get_walltime() << std::endl;
+  std::cout << "Integrator size (bytes): "
+            << sizeof(SdcIntegrator<SparseGaussJordan, VodeSystem, order>) << std::endl;
 
 #ifndef AMREX_USE_CUDA
-  delete[] y_initial;
-  delete[] y_final;
+  delete[] state;
+  delete[] timestep_hints;
 #else
-  cuda_status = cudaFree(y_initial);
+  cuda_status = cudaFree(state);
   assert(cuda_status == cudaSuccess);
-  cuda_status = cudaFree(y_final);
+  cuda_status = cudaFree(timestep_hints);
   assert(cuda_status == cudaSuccess);
 
   cudaProfilerStop();
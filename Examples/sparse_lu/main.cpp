@@ -0,0 +1,142 @@
+#include <iostream>
+#include <iomanip>
+#include <cmath>
+#include <utility>
+#include <type_traits>
+
+#include "SparseLU.H"
+#include "benchmark_problems.H"
+#include "RealVector.H"
+
+// Solve I - dt*J near the initial state of each benchmark problem with
+// SparseLU, once as is and once with every diagonal entry scaled down to
+// a tiny but nonzero value, and check the normwise backward error
+// |b - A*x| / (|A| |x| + |b|) in the max norm. A weak diagonal that is
+// small from the start must be caught by the pivot check like one that
+// cancels during elimination, so the solve falls back to partial pivoting.
+
+const Real maximum_backward_error = 1.0e-12;
+
+template<class System, size_t k>
+void dense_entry(Real (&M)[System::neqs][System::neqs], Real* A) {
+  constexpr int irow = CsrPattern<System>::row(k);
+  constexpr int icol = System::csr_col_index[k];
+  M[irow][icol] = A[k];
+}
+
+template<class System, size_t... K>
+Real backward_error(Real* A, Real* x, Real* b, std::index_sequence<K...>) {
+  const size_t neqs = System::neqs;
+  Real M[neqs][neqs] = {};
+  int expand[] = {0, (dense_entry<System, K>(M, A), 0)...};
+  (void) expand;
+
+  Real residual = 0.0;
+  Real A_norm = 0.0;
+  Real x_norm = 0.0;
+  Real b_norm = 0.0;
+  for (size_t i = 0; i < neqs; i++) {
+    Real r = b[i];
+    Real row_sum = 0.0;
+    for (size_t j = 0; j < neqs; j++) {
+      r -= M[i][j] * x[j];
+      row_sum += std::fabs(M[i][j]);
+    }
+    residual = std::max(residual, std::fabs(r));
+    A_norm = std::max(A_norm, row_sum);
+    x_norm = std::max(x_norm, std::fabs(x[i]));
+    b_norm = std::max(b_norm, std::fabs(b[i]));
+  }
+  return residual / (A_norm * x_norm + b_norm);
+}
+
+template<class System>
+Real backward_error(Real* A, Real* x, Real* b) {
+  return backward_error<System>(A, x, b, std::make_index_sequence<System::nnz>());
+}
+
+// A[i][i] = (A[i][i] + 1) * scale
+template<class System, size_t... R>
+void shift_and_scale_diagonal(Real* A, Real scale, std::index_sequence<R...>) {
+  int expand[] = {0, (A[std::integral_constant<int, CsrPattern<System>::diagonal(R)>::value] =
+                      (A[std::integral_constant<int, CsrPattern<System>::diagonal(R)>::value] + 1.0) * scale, 0)...};
+  (void) expand;
+}
+
+template<class Problem>
+bool check_problem(Real diagonal_scale) {
+  typedef typename Problem::System System;
+  const size_t neqs = System::neqs;
+
+  RealVector<neqs> y, rhs;
+  RealSparseMatrix<neqs, System::nnz, System> jac;
+  // the initial state moved away from zero, where many Jacobian
+  // entries vanish
+  Problem::initial_state(y.data);
+  for (size_t i = 0; i < neqs; i++) {
+    y.data[i] += 0.1 * (1 + i % 3);
+  }
+  System::evaluate(Problem::start_time(), y, rhs, jac);
+
+  Real A[System::nnz];
+  for (size_t k = 0; k < System::nnz; k++) {
+    A[k] = -Problem::timestep() * jac.data[k];
+  }
+  shift_and_scale_diagonal<System>(A, diagonal_scale, std::make_index_sequence<neqs>());
+
+  // a right hand side with components of both signs and several scales
+  Real b[neqs];
+  for (size_t i = 0; i < neqs; i++) {
+    b[i] = (i % 2 == 0 ? 1.0 : -0.5) * (1.0 + i % 3);
+  }
+
+  Real A_solve[System::nnz];
+  for (size_t k = 0; k < System::nnz; k++) A_solve[k] = A[k];
+  Real x[neqs];
+  SparseLU<System>::solve(A_solve, x, b);
+
+  Real error = backward_error<System>(A, x, b);
+  bool passed = error < maximum_backward_error;
+  std::cout << std::setw(10) << Problem::name()
+            << " diagonal scale " << std::setw(6) << diagonal_scale
+            << " backward error " << std::setw(10) << error
+            << (passed ? "" : " FAILED") << std::endl;
+  return passed;
+}
+
+// The 3x3 Robertson pattern with a tiny first diagonal entry and the
+// other entries of order 1
+bool check_tiny_diagonal() {
+  Real A[VodeSystem::nnz] = {1.0e-14, 1.0, 2.0,
+                             1.0, 3.0, 1.0,
+                                  3.0, 1.0};
+  Real A_solve[VodeSystem::nnz];
+  for (size_t k = 0; k < VodeSystem::nnz; k++) A_solve[k] = A[k];
+  Real b[VodeSystem::neqs] = {1.0, 2.0, 3.0};
+  Real x[VodeSystem::neqs];
+  SparseLU<VodeSystem>::solve(A_solve, x, b);
+
+  Real error = backward_error<VodeSystem>(A, x, b);
+  bool passed = error < maximum_backward_error;
+  std::cout << "  3x3 tiny A(0,0)"
+            << " backward error " << std::setw(10) << error
+            << (passed ? "" : " FAILED") << std::endl;
+  return passed;
+}
+
+int main() {
+  bool passed = check_tiny_diagonal();
+  for (Real diagonal_scale : {1.0, 1.0e-14}) {
+    passed = check_problem<RobertsonProblem>(diagonal_scale) && passed;
+    passed = check_problem<HiresProblem>(diagonal_scale) && passed;
+    passed = check_problem<PollutionProblem>(diagonal_scale) && passed;
+    passed = check_problem<OregonatorProblem>(diagonal_scale) && passed;
+    passed = check_problem<SyntheticProblem>(diagonal_scale) && passed;
+  }
+
+  if (!passed) {
+    std::cout << "SparseLU backward error above " << maximum_backward_error << std::endl;
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,113 @@
+import argparse
+import json
+import sys
+
+# Compare two JSON line outputs of Examples/benchmark run by run.
+#
+# Runs are matched on their configuration. For each match this prints the
+# speedup of the second file over the first, the ratios of steps and Newton
+# iterations, the solution error of both against the reference states and
+# the relative difference of the solution checksums. It exits with an error
+# if any checksum difference is larger than the tolerance given with -rtol.
+#
+# With -match, runs are matched on all but the given configuration keys,
+# e.g. -match error_control compares the two error controls of one file,
+# and -match threads -baseline_select threads=1 gives the speedup of each
+# thread count over one thread.
+# Runs written before a configuration key existed match on its value null.
+
+CONFIGURATION = ["problem", "batch", "order", "nodes", "tolerance", "adaptive",
+                 "error_control", "solver", "jacobian_reuse", "mixed_precision", "simd",
+                 "calls", "warm_start", "threads"]
+
+def read_runs(filename, keys, select):
+    # (configuration, run) pairs in file order
+    runs = []
+    with open(filename) as f:
+        for line in f:
+            line = line.strip()
+            if not line:
+                continue
+            run = json.loads(line)
+            if any(str(run.get(key)).lower() != value.lower() for key, value in select.items()):
+                continue
+            runs.append((tuple(run.get(key) for key in keys), run))
+    return runs
+
+def parse_selection(selection):
+    # "key=value" pairs separated by commas
+    select = {}
+    for item in selection.split(","):
+        if item:
+            key, value = item.split("=")
+            select[key] = value
+    return select
+
+def error_text(run):
+    error = run.get("solution_error")
+    return "{:.2e}".format(error) if error is not None else "-"
+
+def counter_mean(run, name):
+    if run.get("counters") is None:
+        return float("nan")
+    return run["counters"][name]["mean"]
+
+def counter_ratio(cand, base, name):
+    # nan if the baseline systems all failed before taking a step
+    baseline_mean = counter_mean(base, name)
+    return counter_mean(cand, name) / baseline_mean if baseline_mean != 0 else float("nan")
+
+if __name__=='__main__':
+    parser = argparse.ArgumentParser()
+    parser.add_argument('baseline', type=str,
+                        help='JSON lines written by the benchmark for the baseline.')
+    parser.add_argument('candidate', type=str,
+                        help='JSON lines written by the benchmark to compare with the baseline.')
+    parser.add_argument('-rtol', type=float, default=None,
+                        help='Fail if the relative solution checksum difference exceeds this.')
+    parser.add_argument('-match', type=str, default="",
+                        help='Comma separated configuration keys to ignore when matching runs.')
+    parser.add_argument('-baseline_select', type=str, default="",
+                        help='Only use baseline runs with these key=value pairs, e.g. error_control=newton.')
+    parser.add_argument('-candidate_select', type=str, default="",
+                        help='Only use candidate runs with these key=value pairs, e.g. error_control=sweep.')
+    args = parser.parse_args()
+
+    ignored = [key for key in args.match.split(",") if key]
+    keys = [key for key in CONFIGURATION if key not in ignored]
+    # each candidate run is compared with the last matching baseline run,
+    # so -match can compare several candidates (e.g. thread counts) with one baseline
+    baseline = dict(read_runs(args.baseline, keys, parse_selection(args.baseline_select)))
+    candidate = read_runs(args.candidate, keys, parse_selection(args.candidate_select))
+
+    print("{:>10} {:>6} {:>5} {:>8} {:>9} {:>5} {:>5} {:>7} {:>9} {:>7} {:>7} {:>9} {:>9} {:>9}".format(
+        "problem", "batch", "order", "nodes", "tol", "adapt", "simd", "threads",
+        "speedup", "steps", "newton", "error", "error", "checksum"))
+
+    worst = 0.0
+    matched = 0
+    for key, cand in candidate:
+        if key not in baseline:
+            continue
+        base = baseline[key]
+        matched += 1
+        speedup = cand["systems_per_second"] / base["systems_per_second"]
+        scale = max(abs(base["solution_checksum"]), sys.float_info.min)
+        difference = abs(cand["solution_checksum"] - base["solution_checksum"]) / scale
+        worst = max(worst, difference)
+        print("{:>10} {:>6} {:>5} {:>8} {:>9.1e} {:>5} {:>5} {:>7} {:>9.3f} {:>7.2f} {:>7.2f} {:>9} {:>9} {:>9.2e}".format(
+            base["problem"], base["batch"], base["order"], base["nodes"], base["tolerance"],
+            int(base["adaptive"]), int(base["simd"]), cand["threads"],
+            speedup, counter_ratio(cand, base, "steps"),
+            counter_ratio(cand, base, "newton_iterations"),
+            error_text(base), error_text(cand), difference))
+
+    print("")
+    print("{} matching runs, steps and newton are candidate/baseline means,".format(matched))
+    print("error is the solution error of the baseline, then of the candidate")
+    print("largest relative checksum difference: {:.3e}".format(worst))
+
+    if matched == 0:
+        sys.exit("no runs with matching configurations")
+    if args.rtol is not None and worst > args.rtol:
+        sys.exit("checksum difference exceeds {}".format(args.rtol))
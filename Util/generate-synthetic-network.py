@@ -0,0 +1,175 @@
+import argparse
+
+# Generate a SystemClass header for a synthetic stiff reaction network.
+#
+# For species i = 0 ... N-1 the network has
+#   y_i -> y_{i+1}                 rate k_i y_i, k_i from 0.1 to 1e5
+#   y_i + y_{i+1} -> 2 y_{i+2}     rate c_i y_i y_{i+1}, c_i from 10 to 1e4
+#   y_{N-1} -> y_0                 rate 1
+# which conserves the sum of all y, and whose Jacobian has the band
+# i-2 ... i+1 plus the corner (0, N-1) that closes the cycle.
+
+def linear_rate(i):
+    return 10.0**((3 * i) % 7 - 1)
+
+def recombination_rate(i):
+    return 10.0**((5 * i) % 4 + 1)
+
+def number(v):
+    if 1.0e-3 <= abs(v) < 1.0e5:
+        return repr(v)
+    mantissa, exponent = ("%.6e" % v).split("e")
+    mantissa = mantissa.rstrip("0")
+    if mantissa.endswith("."):
+        mantissa += "0"
+    return "{}e{}".format(mantissa, int(exponent))
+
+def build_network(n):
+    # reactions as (rate constant, reactants, products)
+    reactions = []
+    for i in range(n-1):
+        reactions.append((linear_rate(i), [i], [i+1]))
+    for i in range(n-2):
+        reactions.append((recombination_rate(i), [i, i+1], [i+2, i+2]))
+    reactions.append((1.0, [n-1], [0]))
+    return reactions
+
+def net_stoichiometry(reactions, n):
+    nu = [[0] * len(reactions) for _ in range(n)]
+    for m, (k, reactants, products) in enumerate(reactions):
+        for s in reactants:
+            nu[s][m] -= 1
+        for s in products:
+            nu[s][m] += 1
+    return nu
+
+def rate_code(m, reaction):
+    k, reactants, products = reaction
+    factors = " * ".join("y.data[{}]".format(s) for s in reactants)
+    return "RealType r{} = {} * {};".format(m, number(k), factors)
+
+def rhs_code(i, nu):
+    terms = ""
+    for m, coefficient in enumerate(nu[i]):
+        if coefficient == 0:
+            continue
+        sign = "-" if coefficient < 0 else "+"
+        scale = "" if abs(coefficient) == 1 else "{}.0 * ".format(abs(coefficient))
+        terms += " {} {}r{}".format(sign, scale, m)
+    terms = terms.strip()
+    if terms.startswith("+ "):
+        terms = terms[2:]
+    elif terms.startswith("- "):
+        terms = "-" + terms[2:]
+    return "rhs.data[{}] = {};".format(i, terms if terms else "0.0")
+
+def jacobian_entries(reactions, nu, n):
+    # Returns the CSR column index, row count and the code for each entry
+    col_index = []
+    row_count = [0]
+    entries = []
+    for i in range(n):
+        for j in range(n):
+            terms = {}
+            keys = []
+            for m, (k, reactants, products) in enumerate(reactions):
+                if nu[i][m] == 0 or j not in reactants:
+                    continue
+                others = list(reactants)
+                others.remove(j)
+                key = tuple(others)
+                if key not in terms:
+                    terms[key] = 0.0
+                    keys.append(key)
+                terms[key] += nu[i][m] * k
+            if not terms and i != j:
+                continue
+            code = ""
+            for key in keys:
+                v = terms[key]
+                sign = "-" if v < 0 else "+"
+                code += " {} {}{}".format(sign, number(abs(v)),
+                                         "".join(" * y.data[{}]".format(s) for s in key))
+            code = code.strip()
+            if code.startswith("+ "):
+                code = code[2:]
+            elif code.startswith("- "):
+                code = "-" + code[2:]
+            col_index.append(j)
+            entries.append(code if code else "0.0e0")
+        row_count.append(len(col_index))
+    return col_index, row_count, entries
+
+def generate(n, class_name):
+    reactions = build_network(n)
+    nu = net_stoichiometry(reactions, n)
+    col_index, row_count, entries = jacobian_entries(reactions, nu, n)
+    guard = "{}_H".format("".join("_" + c if c.isupper() else c.upper() for c in class_name).lstrip("_"))
+
+    out = []
+    out.append("#ifndef {}".format(guard))
+    out.append("#define {}".format(guard))
+    out.append("")
+    out.append('#include "RealVector.H"')
+    out.append('#include "RealSparseMatrix.H"')
+    out.append("")
+    out.append("// Synthetic stiff reaction network with {} species and {} reactions,".format(n, len(reactions)))
+    out.append("// generated by Util/generate-synthetic-network.py -n {}".format(n))
+    out.append("")
+    out.append("class {} {{".format(class_name))
+    out.append("public:")
+    out.append("    static const size_t neqs = {};".format(n))
+    out.append("    static const size_t nnz = {};".format(len(col_index)))
+    out.append("")
+    out.append("    // Jacobian sparsity pattern in CSR format, used at compile time")
+    out.append("    static constexpr int csr_col_index[nnz] = {")
+    for i in range(n):
+        row = ", ".join(str(c) for c in col_index[row_count[i]:row_count[i+1]])
+        out.append("        {}{}".format(row, "," if i < n-1 else ""))
+    out.append("    };")
+    out.append("    static constexpr int csr_row_count[neqs+1] = {")
+    for start in range(0, n+1, 16):
+        chunk = ", ".join(str(c) for c in row_count[start:start+16])
+        out.append("        {}{}".format(chunk, "," if start + 16 < n+1 else ""))
+    out.append("    };")
+
+    for with_jacobian in [False, True]:
+        out.append("")
+        if with_jacobian:
+            out.append("    template<class RealType, class JacType>")
+        else:
+            out.append("    template<class RealType>")
+        out.append("    AMREX_GPU_HOST_DEVICE AMREX_INLINE")
+        if with_jacobian:
+            out.append("    static void evaluate(RealType time, MathVector<RealType,neqs>& y, MathVector<RealType,neqs>& rhs,")
+            out.append("                         MathVector<JacType,nnz>& jac) {")
+        else:
+            out.append("    static void evaluate(RealType time, MathVector<RealType,neqs>& y, MathVector<RealType,neqs>& rhs) {")
+        for m, reaction in enumerate(reactions):
+            out.append("        " + rate_code(m, reaction))
+        out.append("")
+        for i in range(n):
+            out.append("        " + rhs_code(i, nu))
+        if with_jacobian:
+            out.append("")
+            for i in range(n):
+                for q in range(row_count[i], row_count[i+1]):
+                    out.append("        jac.data[{}] = {};".format(q, entries[q]))
+        out.append("    }")
+
+    out.append("};")
+    out.append("#endif")
+    return "\n".join(out) + "\n"
+
+if __name__=='__main__':
+    parser = argparse.ArgumentParser()
+    parser.add_argument('-n', type=int, default=64,
+                        help='Number of species in the network.')
+    parser.add_argument('-name', type=str, default='SyntheticNetwork',
+                        help='Name of the generated SystemClass.')
+    parser.add_argument('-o', type=str, default='synthetic_network.H',
+                        help='Name of the C++ header file to generate.')
+    args = parser.parse_args()
+
+    with open(args.o, 'w') as f:
+        f.write(generate(args.n, args.name))